@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2005-2025 Uluç Saranlı. All Rights Reserved
+ *
+ * This file is part of the RoboMETU robot control software library
+ * collection. Unauthorized copying of this file, via any medium is
+ * strictly prohibited.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/inotify.h>
+
+#include "ConfigWatcher.hh"
+
+using namespace rtcore;
+
+// Comment in/out beyond printf to enable/disable debug messages
+#define DBGPRINT(...) //printf(__VA_ARGS__);
+
+#define CONFIGWATCH_POLL_MS 100
+// Time in seconds without modifications before a reload is signaled
+#define CONFIGWATCH_SETTLE 0.3
+
+static double monotonicTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static bool endsWith(const char *str, const char *suffix) {
+  size_t l = strlen(str), s = strlen(suffix);
+  return l >= s && strcmp(str + l - s, suffix) == 0;
+}
+
+ConfigWatcher::ConfigWatcher(ModuleManager *mgr) : _mgr(mgr) {
+  DBGPRINT("ConfigWatcher::ConfigWatcher\n");
+}
+
+ConfigWatcher::~ConfigWatcher() {
+  DBGPRINT("ConfigWatcher::~ConfigWatcher\n");
+  stop();
+  delete _staging;
+}
+
+bool ConfigWatcher::load() {
+  return _build(_mgr);
+}
+
+bool ConfigWatcher::_build(ModuleManager *mm) {
+  mm->clearConfig();
+  bool res;
+  res = mm->appendConfigFile("list.toml");
+  res = res && mm->appendConfigFile("versionlist.toml");
+  res = res && mm->appendConfigFile("robotlist.toml");
+  if (!mm->appendConfigFile("localoverrides.toml")) {
+    _mgr->warning("ConfigWatcher", "Could not find localoverrides.toml, skipping");
+  }
+  res = res && mm->appendConfigString(_config.c_str());
+  if (!res) {
+    _mgr->warning("ConfigWatcher", "Could not find one or more configuration files!");
+    return false;
+  }
+  if (!mm->finalizeConfig()) {
+    _mgr->warning("ConfigWatcher", "Error reading configuration files!");
+    return false;
+  }
+  return true;
+}
+
+ModuleManager *ConfigWatcher::acquire() {
+  int ready = ST_READY;
+  return _stage.compare_exchange_strong(ready, ST_BUSY) ? _staging : nullptr;
+}
+
+void ConfigWatcher::release() {
+  int busy = ST_BUSY;
+  _stage.compare_exchange_strong(busy, ST_IDLE);
+}
+
+bool ConfigWatcher::watch() {
+  if (_watching) return true;
+
+  _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (_fd < 0) {
+    _mgr->warning("ConfigWatcher", "inotify unavailable, configuration reload disabled");
+    return false;
+  }
+
+  _addWatch(".", "localoverrides.toml");
+  _addWatch(getenv("CONFIG_DIR"), "");
+  _addWatch(getenv("VERSION_DIR"), "");
+  _addWatch(getenv("ROBOT_DIR"), "");
+
+  if (_watches.empty()) {
+    close(_fd);
+    _fd = -1;
+    return false;
+  }
+
+  // Reloads are parsed into a database of their own, see acquire()
+  if (!_staging) _staging = new ModuleManager;
+
+  _dirty = false;
+  _stage = ST_IDLE;
+  _watching = true;
+  start("configwatch", 0); // Low priority, this is not time critical
+  return true;
+}
+
+void ConfigWatcher::stop() {
+  if (!_watching) return;
+  terminate();
+  _watching = false;
+}
+
+void ConfigWatcher::_addWatch(const char *dir, const char *file) {
+  if (!dir || !dir[0]) return;
+
+  // Directories are watched rather than files so that editors replacing a
+  // file through a rename are caught as well
+  int wd = inotify_add_watch(_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (wd < 0) {
+    _mgr->warning("ConfigWatcher", "Cannot watch %s: %s", dir, strerror(errno));
+    return;
+  }
+  DBGPRINT("ConfigWatcher: Watching %s\n", dir);
+  _watches.push_back(std::make_pair(wd, std::string(file)));
+}
+
+void ConfigWatcher::threadEnter() {
+  DBGPRINT("ConfigWatcher::threadEnter\n");
+}
+
+void ConfigWatcher::threadLoop() {
+  struct pollfd pfd = { _fd, POLLIN, 0 };
+
+  if (poll(&pfd, 1, CONFIGWATCH_POLL_MS) > 0 && (pfd.revents & POLLIN)) {
+    alignas(struct inotify_event) char buf[4096];
+    ssize_t len;
+    while ((len = read(_fd, buf, sizeof(buf))) > 0) {
+      for (char *p = buf; p < buf + len; ) {
+        struct inotify_event *ev = (struct inotify_event *)p;
+        p += sizeof(struct inotify_event) + ev->len;
+        if (ev->len == 0) continue;
+
+        for (const auto &w : _watches) {
+          if (w.first != ev->wd) continue;
+          bool match = w.second.empty() ? endsWith(ev->name, ".toml") : (w.second == ev->name);
+          if (match) {
+            DBGPRINT("ConfigWatcher: %s modified\n", ev->name);
+            _dirty = true;
+            _lastEvent = monotonicTime();
+          }
+        }
+      }
+    }
+  }
+
+  // Parse a settled batch unless the consumer still has the previous one
+  if (_dirty && monotonicTime() - _lastEvent > CONFIGWATCH_SETTLE && _stage == ST_IDLE) {
+    _dirty = false;
+    if (_build(_staging)) {
+      _stage = ST_READY;
+    } else {
+      _mgr->warning("ConfigWatcher", "Configuration reload failed, keeping current parameters.");
+    }
+  }
+}
+
+void ConfigWatcher::threadExit() {
+  DBGPRINT("ConfigWatcher::threadExit\n");
+
+  if (_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+  }
+  _watches.clear();
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2005-2025 Uluç Saranlı. All Rights Reserved
+ *
+ * This file is part of the RoboMETU robot control software library
+ * collection. Unauthorized copying of this file, via any medium is
+ * strictly prohibited.
+*/
+
+#ifndef _CONFIGWATCHER_HH
+#define _CONFIGWATCHER_HH
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "rtcore/ModuleManager.hh"
+#include "rtcore/ThreadedLoop.hh"
+
+/** \brief Loads the configuration database and watches it for changes
+
+  This class builds the ModuleManager configuration from list.toml,
+  versionlist.toml, robotlist.toml, localoverrides.toml and the command line
+  configuration string. Once watch() is called, it also runs a ThreadedLoop
+  that uses inotify to monitor localoverrides.toml in the working directory
+  and all .toml files in the CONFIG_DIR, VERSION_DIR and ROBOT_DIR
+  directories.
+
+  Modifications are debounced so that editors writing files in several steps
+  only trigger a single reload. The watcher thread then reads and parses the
+  whole file set into a separate staging ModuleManager, so neither file
+  access nor parsing happens on the control thread, and a half saved or
+  invalid file never touches the database modules are running with. Only a
+  successfully parsed set is offered through acquire(), which the consumer
+  calls at a tick boundary to read its new parameters from, followed by
+  release() once done. The watcher does not rebuild the staged database in
+  between. The process wide database keeps the configuration from load().
+ */
+class ConfigWatcher : rtcore::ThreadedLoop {
+public:
+  ConfigWatcher(rtcore::ModuleManager *mgr);
+  ~ConfigWatcher();
+
+  /** \brief Extra configuration appended after all files */
+  void setConfigString(const std::string &config) { _config = config; }
+  /** \brief Rebuilds the configuration database from scratch */
+  bool load();
+
+  /** \brief Starts watching the configuration files for modifications */
+  bool watch();
+  /** \brief Stops the watcher thread */
+  void stop();
+  /** \brief Returns the staged database once for each settled and
+      successfully parsed batch of modifications, nullptr otherwise */
+  rtcore::ModuleManager *acquire();
+  /** \brief Hands the database obtained from acquire() back to the watcher */
+  void release();
+
+  void threadEnter();
+  void threadLoop();
+  void threadExit();
+
+private:
+  /** \brief States of the staged database */
+  typedef enum { ST_IDLE, ST_READY, ST_BUSY } _stage_t;
+
+  bool _build(rtcore::ModuleManager *mm);
+  void _addWatch(const char *dir, const char *file);
+
+  rtcore::ModuleManager *_mgr;
+  rtcore::ModuleManager *_staging = nullptr;
+  std::string _config;
+
+  int _fd = -1;
+  bool _watching = false;
+  // Watch descriptors and the file they are restricted to, empty for *.toml
+  std::vector<std::pair<int, std::string>> _watches;
+
+  bool _dirty = false;    // Modifications seen, waiting for them to settle
+  double _lastEvent = 0;  // Monotonic time of the last modification
+  std::atomic<int> _stage{ ST_IDLE };
+};
+
+#endif
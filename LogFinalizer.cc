@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2005-2025 Uluç Saranlı. All Rights Reserved
+ *
+ * This file is part of the RoboMETU robot control software library
+ * collection. Unauthorized copying of this file, via any medium is
+ * strictly prohibited.
+*/
+
+#include <stdio.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "LogFinalizer.hh"
+
+using namespace rtcore;
+
+extern char **environ;
+
+// Comment in/out beyond printf to enable/disable debug messages
+#define DBGPRINT(...) //printf(__VA_ARGS__);
+
+#define FINALIZER_USLEEP 10000
+
+LogFinalizer::LogFinalizer(ModuleManager *mgr, ModuleArena *arena) : _mgr(mgr), _arena(arena) {
+  DBGPRINT("LogFinalizer::LogFinalizer\n");
+  start("logfinal", 0); // Lowest priority, nothing waits on this
+}
+
+LogFinalizer::~LogFinalizer() {
+  DBGPRINT("LogFinalizer::~LogFinalizer\n");
+  wait();
+  terminate();
+}
+
+void LogFinalizer::push(const segment_t &seg) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _queue.push_back(seg);
+}
+
+int LogFinalizer::pending() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _queue.size() + _busy;
+}
+
+void LogFinalizer::wait() {
+  while (pending() > 0) usleep(FINALIZER_USLEEP);
+}
+
+void LogFinalizer::threadEnter() {
+  DBGPRINT("LogFinalizer::threadEnter\n");
+}
+
+void LogFinalizer::threadLoop() {
+  segment_t seg;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_queue.empty()) {
+      seg = _queue.front();
+      _queue.pop_front();
+      _busy = 1;
+    }
+  }
+  if (!_busy) {
+    usleep(FINALIZER_USLEEP);
+    return;
+  }
+
+  _finalize(seg);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _busy = 0;
+}
+
+void LogFinalizer::threadExit() {
+  DBGPRINT("LogFinalizer::threadExit\n");
+}
+
+void LogFinalizer::_finalize(const segment_t &seg) {
+  DBGPRINT("LogFinalizer: Finalizing %s\n", seg.file.c_str());
+
+  // Destroying the writer completes the file
+  if (seg.writer && !_arena->destroy(seg.writer))
+    _mgr->warning("LogFinalizer", "Arena could not destroy the writer of %s", seg.file.c_str());
+
+  std::string file = seg.file;
+  if (seg.compress) {
+    pid_t pid;
+    const char *argv[] = { "gzip", "-f", seg.file.c_str(), nullptr };
+    int status = -1;
+    if (posix_spawnp(&pid, "gzip", nullptr, nullptr, (char *const *)argv, environ) == 0
+        && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+      file += ".gz";
+    } else {
+      _mgr->warning("LogFinalizer", "Could not compress %s", seg.file.c_str());
+    }
+  }
+
+  if (!seg.index.empty()) {
+    FILE *f = fopen(seg.index.c_str(), "a");
+    if (f) {
+      fprintf(f, "%s %.3f %.3f\n", file.c_str(), seg.tstart, seg.tend);
+      fclose(f);
+    } else {
+      _mgr->warning("LogFinalizer", "Could not update index %s", seg.index.c_str());
+    }
+  }
+  _mgr->message("LogFinalizer: Closed log segment %s (t=%.3f-%.3f s)", file.c_str(), seg.tstart,
+                seg.tend);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2005-2025 Uluç Saranlı. All Rights Reserved
+ *
+ * This file is part of the RoboMETU robot control software library
+ * collection. Unauthorized copying of this file, via any medium is
+ * strictly prohibited.
+*/
+
+#ifndef _LOGFINALIZER_HH
+#define _LOGFINALIZER_HH
+
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "rtcore/ModuleManager.hh"
+#include "rtcore/ThreadedLoop.hh"
+#include "rtclient/LogWriter.hh"
+
+#include "control_modules/ModuleArena.hh"
+
+/** \brief Background finalization of closed log segments
+
+  When the Supervisor rolls its local log over to a new segment, the writer
+  of the previous one is handed to this class instead of being destroyed in
+  the log thread. Its ThreadedLoop then destroys the writer, which completes
+  the file (e.g. the MATLAB header), optionally compresses the file with gzip
+  and finally appends a line with the file name and time span of the segment
+  to the index file.
+
+  Segments are finalized in the order they were pushed, so the index lists
+  them in recording order. Writers must have been created in the arena given
+  to the constructor.
+ */
+class LogFinalizer : rtcore::ThreadedLoop {
+public:
+  /** \brief A closed segment waiting to be finalized */
+  typedef struct {
+    rtclient::LogWriter *writer;
+    std::string file;
+    std::string index;   // Index file to append to, empty for none
+    double tstart, tend;
+    bool compress;
+  } segment_t;
+
+  LogFinalizer(rtcore::ModuleManager *mgr, ModuleArena *arena);
+  ~LogFinalizer();
+
+  /** \brief Queues a segment for finalization in the background */
+  void push(const segment_t &seg);
+  /** \brief Number of segments queued or being finalized */
+  int pending();
+  /** \brief Blocks until all queued segments are finalized */
+  void wait();
+
+  void threadEnter();
+  void threadLoop();
+  void threadExit();
+
+private:
+  void _finalize(const segment_t &seg);
+
+  rtcore::ModuleManager *_mgr;
+  ModuleArena *_arena;
+
+  std::mutex _mutex;
+  std::deque<segment_t> _queue;
+  int _busy = 0;
+};
+
+#endif
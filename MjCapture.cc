@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2005-2025 Uluç Saranlı. All Rights Reserved
+ *
+ * This file is part of the RoboMETU robot control software library
+ * collection. Unauthorized copying of this file, via any medium is
+ * strictly prohibited.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "MjCapture.hh"
+
+using namespace rtcore;
+
+// Comment in/out beyond printf to enable/disable debug messages
+#define DBGPRINT(...) //printf(__VA_ARGS__);
+
+#define CAPTURE_USLEEP 5000
+
+MjCapture *MjCapture::_instance = nullptr;
+
+MjCapture::MjCapture(ModuleManager *mgr) : _mgr(mgr) {
+  DBGPRINT("MjCapture::MjCapture\n");
+  _full[0] = _full[1] = false;
+}
+
+MjCapture::~MjCapture() {
+  DBGPRINT("MjCapture::~MjCapture\n");
+  close();
+}
+
+bool MjCapture::configure() {
+  ConfigTable sim, config;
+  if (!_mgr->getConfigTable("simulation", sim) || !sim.getTable("capture", config))
+    return false;
+  if (!config.getBool("enable", false)) return false;
+
+  _filename = config.getString("file_name", "mjcapture.bin");
+  _maxcon = std::max(config.getInt("max_contacts", 16), 0);
+  _bufsteps = std::max(config.getInt("buffer_steps", 4096), 1);
+  _decimation = std::max(config.getInt("decimation", 1), 1);
+
+  ConfigArray fields;
+  if (config.getArray("fields", fields)) {
+    _fields = 0;
+    for (int i = 0; i < fields.size(); i++) {
+      std::string name = fields.getStringAt(i);
+      if (name == "qpos") _fields |= CAP_QPOS;
+      else if (name == "qvel") _fields |= CAP_QVEL;
+      else if (name == "ctrl") _fields |= CAP_CTRL;
+      else if (name == "qfrc_constraint") _fields |= CAP_QFRC_CONSTRAINT;
+      else if (name == "contact") _fields |= CAP_CONTACT;
+      else _mgr->warning("MjCapture", "Unknown capture field '%s'", name.c_str());
+    }
+  }
+  return true;
+}
+
+bool MjCapture::install() {
+  if (_installed) return true;
+  if (_instance) {
+    _mgr->warning("MjCapture", "Another capture is already installed");
+    return false;
+  }
+  _instance = this;
+  _prevcb = mjcb_control;
+  mjcb_control = _controlHook;
+  _installed = true;
+  start("mjcapture", 0); // Low priority, the physics loop must not wait on it
+  _mgr->message("MjCapture: Capturing physics steps to %s", _filename.c_str());
+  return true;
+}
+
+void MjCapture::_controlHook(const mjModel *m, mjData *d) {
+  MjCapture *cap = _instance;
+  if (!cap) return;
+  // Let the previous callback set controls first so that ctrl is captured as applied
+  if (cap->_prevcb) cap->_prevcb(m, d);
+  cap->_capture(m, d);
+}
+
+// Runs in the writer thread once the first step has provided the model
+bool MjCapture::_open(const mjModel *m) {
+  _recsize = 1;
+  if (_fields & CAP_QPOS) _recsize += m->nq;
+  if (_fields & CAP_QVEL) _recsize += m->nv;
+  if (_fields & CAP_CTRL) _recsize += m->nu;
+  if (_fields & CAP_QFRC_CONSTRAINT) _recsize += m->nv;
+  if (_fields & CAP_CONTACT) _recsize += 1 + _maxcon * CAPTURE_CONTACT_SIZE;
+
+  size_t bytes = (size_t)_recsize * _bufsteps * sizeof(mjtNum);
+  for (int b = 0; b < 2; b++) {
+    if (posix_memalign((void **)&_buffer[b], 64, bytes) != 0) {
+      _buffer[b] = nullptr;
+      _mgr->warning("MjCapture", "Cannot allocate %zu byte capture buffers", bytes);
+      return false;
+    }
+    // Fault all pages in now rather than in the physics loop
+    memset(_buffer[b], 0, bytes);
+    _count[b] = 0;
+    _full[b] = false;
+  }
+  _active = 0;
+  _nextWrite = 0;
+
+  _file = fopen(_filename.c_str(), "wb");
+  if (!_file) {
+    _mgr->warning("MjCapture", "Cannot open %s for writing", _filename.c_str());
+    return false;
+  }
+
+  header_t hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  strncpy(hdr.magic, "MJCAP02", sizeof(hdr.magic));
+  hdr.nq = m->nq;
+  hdr.nv = m->nv;
+  hdr.nu = m->nu;
+  hdr.max_contacts = _maxcon;
+  hdr.fields = _fields;
+  hdr.record_size = _recsize;
+  fwrite(&hdr, sizeof(hdr), 1, _file);
+  return true;
+}
+
+void MjCapture::_capture(const mjModel *m, const mjData *d) {
+  // Nothing is recorded until the writer thread has set everything up
+  if (!_ready.load(std::memory_order_acquire)) {
+    if (!_model.load(std::memory_order_relaxed)) _model.store(m, std::memory_order_release);
+    return;
+  }
+
+  if (++_skip < _decimation) return;
+  _skip = 0;
+
+  // A filled buffer stays with the writer, go on in the other one once the
+  // writer is done with it. The writer may already have cleared the full
+  // flag of the active buffer, so its count decides.
+  if (_count[_active] == _bufsteps) {
+    int other = 1 - _active;
+    if (_full[other].load(std::memory_order_acquire)) {
+      _dropped++;
+      return;
+    }
+    _active = other;
+    _count[_active] = 0;
+  }
+
+  mjtNum *r = _buffer[_active] + (size_t)_count[_active] * _recsize;
+  *r++ = d->time;
+  if (_fields & CAP_QPOS) {
+    memcpy(r, d->qpos, m->nq * sizeof(mjtNum));
+    r += m->nq;
+  }
+  if (_fields & CAP_QVEL) {
+    memcpy(r, d->qvel, m->nv * sizeof(mjtNum));
+    r += m->nv;
+  }
+  if (_fields & CAP_CTRL) {
+    memcpy(r, d->ctrl, m->nu * sizeof(mjtNum));
+    r += m->nu;
+  }
+  if (_fields & CAP_QFRC_CONSTRAINT) {
+    memcpy(r, d->qfrc_constraint, m->nv * sizeof(mjtNum));
+    r += m->nv;
+  }
+  if (_fields & CAP_CONTACT) {
+    int ncon = std::min(d->ncon, _maxcon);
+    *r++ = ncon;
+    for (int i = 0; i < ncon; i++) {
+      const mjContact &c = d->contact[i];
+      r[0] = c.geom[0];
+      r[1] = c.geom[1];
+      r[2] = c.dist;
+      memcpy(r + 3, c.pos, 3 * sizeof(mjtNum));
+      memcpy(r + 6, c.frame, 3 * sizeof(mjtNum));
+      r += CAPTURE_CONTACT_SIZE;
+    }
+    memset(r, 0, (size_t)(_maxcon - ncon) * CAPTURE_CONTACT_SIZE * sizeof(mjtNum));
+  }
+
+  _captured++;
+  if (++_count[_active] == _bufsteps) _full[_active].store(true, std::memory_order_release);
+}
+
+void MjCapture::_writeBuffer(int b) {
+  if (_count[b] > 0)
+    fwrite(_buffer[b], _recsize * sizeof(mjtNum), _count[b], _file);
+}
+
+void MjCapture::threadEnter() {
+  DBGPRINT("MjCapture::threadEnter\n");
+}
+
+void MjCapture::threadLoop() {
+  if (!_ready.load(std::memory_order_relaxed)) {
+    const mjModel *m = _model.load(std::memory_order_acquire);
+    if (m && !_failed) {
+      if (_open(m)) _ready.store(true, std::memory_order_release);
+      else _failed = true;
+    } else {
+      usleep(CAPTURE_USLEEP);
+    }
+    return;
+  }
+
+  if (_full[_nextWrite].load(std::memory_order_acquire)) {
+    _writeBuffer(_nextWrite);
+    _full[_nextWrite].store(false, std::memory_order_release);
+    _nextWrite = 1 - _nextWrite;
+  } else {
+    usleep(CAPTURE_USLEEP);
+  }
+}
+
+void MjCapture::threadExit() {
+  DBGPRINT("MjCapture::threadExit\n");
+}
+
+void MjCapture::close() {
+  // The writer thread runs from install() on
+  bool started = _installed;
+  if (_installed) {
+    if (mjcb_control == _controlHook) mjcb_control = _prevcb;
+    _instance = nullptr;
+    _installed = false;
+  }
+
+  if (started) terminate();
+  _ready = false;
+  _model = nullptr;
+
+  if (_file) {
+    // Write out whatever the writer thread did not get to, in order
+    for (int i = 0; i < 2; i++) {
+      if (_full[_nextWrite]) {
+        _writeBuffer(_nextWrite);
+        _full[_nextWrite] = false;
+        _nextWrite = 1 - _nextWrite;
+      }
+    }
+    if (_count[_active] > 0 && _count[_active] < _bufsteps) {
+      // Only the partially filled buffer is left
+      if (_active == _nextWrite) _writeBuffer(_active);
+    }
+    fclose(_file);
+    _file = nullptr;
+
+    _mgr->message("MjCapture: Captured %lu steps, dropped %lu", (unsigned long)_captured,
+                  (unsigned long)_dropped);
+  }
+
+  for (int b = 0; b < 2; b++) {
+    free(_buffer[b]);
+    _buffer[b] = nullptr;
+  }
+}
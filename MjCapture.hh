@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2005-2025 Uluç Saranlı. All Rights Reserved
+ *
+ * This file is part of the RoboMETU robot control software library
+ * collection. Unauthorized copying of this file, via any medium is
+ * strictly prohibited.
+*/
+
+#ifndef _MJCAPTURE_HH
+#define _MJCAPTURE_HH
+
+#include <stdio.h>
+#include <atomic>
+#include <string>
+
+#include <mujoco/mujoco.h>
+
+#include "rtcore/ModuleManager.hh"
+#include "rtcore/ThreadedLoop.hh"
+
+// Doubles stored per contact
+#define CAPTURE_CONTACT_SIZE 9
+
+/** \brief Physics-rate capture of MuJoCo simulation state
+
+  This class copies selected mjData fields into one of two preallocated
+  buffers on every physics step, and streams filled buffers to a binary file
+  from a low priority ThreadedLoop. The physics thread never blocks, never
+  allocates and never touches the file. If the writer falls behind so that
+  both buffers are full, new steps are dropped and counted instead.
+
+  Since the MuJoCo hardware layer owns the step loop, install() hooks the
+  global mjcb_control callback, chaining any callback already set, and
+  starts the writer thread. The first step only hands the model to the
+  writer thread, which then sizes and prefaults the buffers, opens the file
+  and writes the header. Steps are recorded once that is done. State is
+  captured at the start of each step after collision detection, so qpos and
+  qvel are the result of the previous step and contacts are those of the
+  current one, while qfrc_constraint still holds the constraint forces of
+  the previous step. Per-contact forces are not available, since there is no
+  callback after the constraint solver, and are therefore not recorded.
+
+  The file starts with a header_t followed by fixed size records of doubles
+  holding the time and then, for each selected field in this order, qpos[nq],
+  qvel[nv], ctrl[nu], qfrc_constraint[nv] and the number of contacts followed
+  by max_contacts entries of CAPTURE_CONTACT_SIZE doubles (geom1, geom2,
+  dist, pos[3], normal[3]). Unused contact entries are zero.
+
+  Capture is configured through the simulation.capture table with the
+  entries enable, file_name, fields (any of "qpos", "qvel", "ctrl",
+  "qfrc_constraint" and "contact"), max_contacts, buffer_steps (records per
+  buffer) and decimation (capture every n-th step).
+ */
+class MjCapture : rtcore::ThreadedLoop {
+public:
+  /** \brief Selectable fields */
+  enum {
+    CAP_QPOS = 0x01,
+    CAP_QVEL = 0x02,
+    CAP_CTRL = 0x04,
+    CAP_QFRC_CONSTRAINT = 0x08,
+    CAP_CONTACT = 0x10
+  };
+
+  /** \brief File header preceding all records */
+  typedef struct {
+    char magic[8];          // "MJCAP02"
+    int nq, nv, nu;
+    int max_contacts;
+    int fields;             // Bitmask of captured fields
+    int record_size;        // Record size in doubles
+    int reserved[2];
+  } header_t;
+
+  MjCapture(rtcore::ModuleManager *mgr);
+  ~MjCapture();
+
+  /** \brief Reads options from the simulation.capture table. Returns false
+      if capture is not enabled. */
+  bool configure();
+  /** \brief Captures from mjcb_control and starts the writer thread, which
+      sets up buffers and file once the first step provides the model */
+  bool install();
+  /** \brief Removes the hook, writes out remaining data and closes the file */
+  void close();
+
+  unsigned long getCaptured() const { return _captured; }
+  unsigned long getDropped() const { return _dropped; }
+
+  void threadEnter();
+  void threadLoop();
+  void threadExit();
+
+private:
+  static void _controlHook(const mjModel *m, mjData *d);
+  void _capture(const mjModel *m, const mjData *d);
+  bool _open(const mjModel *m);
+  void _writeBuffer(int b);
+
+  rtcore::ModuleManager *_mgr;
+
+  // Configuration
+  std::string _filename = "mjcapture.bin";
+  int _fields = CAP_QPOS | CAP_QVEL | CAP_CONTACT;
+  int _maxcon = 16;
+  int _bufsteps = 4096;
+  int _decimation = 1;
+
+  FILE *_file = nullptr;
+  bool _installed = false;
+  bool _failed = false;
+  std::atomic<const mjModel *> _model{ nullptr }; // Handed over by the first step
+  std::atomic<bool> _ready{ false };              // Buffers and file are set up
+  mjfGeneric _prevcb = nullptr;
+
+  int _recsize = 0;        // Record size in doubles
+  mjtNum *_buffer[2] = { nullptr, nullptr };
+  int _count[2] = { 0, 0 };
+  std::atomic<bool> _full[2];
+  int _active = 0;         // Buffer being filled by the physics thread
+  int _nextWrite = 0;      // Buffer to be written next by the writer thread
+  int _skip = 0;
+
+  std::atomic<unsigned long> _captured{ 0 };
+  std::atomic<unsigned long> _dropped{ 0 };
+
+  static MjCapture *_instance;
+};
+
+#endif
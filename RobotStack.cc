@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2005-2025 Uluç Saranlı. All Rights Reserved
+ *
+ * This file is part of the RoboMETU robot control software library
+ * collection. Unauthorized copying of this file, via any medium is
+ * strictly prohibited.
+*/
+
+#include <stdio.h>
+
+#include "rtcore/Module.hh"
+#include "rtcore/ThreadUtil.hh"
+
+#include "hardware/MotorHW.hh"
+#include "quadruped/CoreModules.hh"
+
+#include "RobotStack.hh"
+#include "Supervisor.hh"
+#ifdef _SIMULATION_
+#include "MjCapture.hh"
+#endif
+
+using namespace rtcore;
+
+// Comment in/out beyond printf to enable/disable debug messages
+#define DBGPRINT(...) //printf(__VA_ARGS__);
+
+int RobotStack::_instances = 0;
+
+RobotStack::RobotStack() : _watcher(&_mm) {
+  DBGPRINT("RobotStack::RobotStack\n");
+}
+
+RobotStack::~RobotStack() {
+  DBGPRINT("RobotStack::~RobotStack\n");
+  shutdown();
+}
+
+bool RobotStack::init(const std::string &config) {
+  if (_initialized) return true;
+
+  // The hardware layer keeps its state in globals, see the class comment
+  if (_instances > 0) {
+    _mm.warning("RobotStack", "Only one robot stack per process is supported");
+    return false;
+  }
+
+  // The watcher also lets the supervisor reload changed configuration files
+  _watcher.setConfigString(config);
+  if (!_watcher.load()) {
+    _mm.warning("RobotStack", "Error reading configuration files!");
+    return false;
+  }
+
+  //printf("*** CURRENT CONFIG ***\n");
+  //_mm.getConfigRoot()->print();
+  //printf("**********************\n");
+
+  _instances++;
+  _initialized = true;
+
+  initHardware( &_mm );
+
+#ifdef _SIMULATION_
+  // Optional physics-rate state capture, see simulation.capture
+  _capture = new MjCapture( &_mm );
+  if (_capture->configure()) _capture->install();
+#endif
+
+  AddCoreModules( &_mm );
+  ActivateCoreModules( &_mm );
+
+  // This activates the supervisor, which in turn activates other modules
+  _supervisor = new Supervisor;
+  _supervisor->setConfigWatcher( &_watcher );
+  _mm.addModule(_supervisor, 1, 0, USER_CONTROLLERS);
+  _mm.activateModule( _supervisor );
+
+  _mm.message("\n** Current list of modules:");
+  _mm.printModules();
+  _mm.message("\n** Current list of threads:");
+  ThreadUtil::printThreads();
+  return true;
+}
+
+void RobotStack::run() {
+  if (!_initialized) return;
+
+  //_mm.setStepPeriod( 2000 ); // OPTIONAL: Sets the update period to 1ms = 1000us
+  _mm.message("\n** Entering main loop...");
+  _mm.mainLoop();
+  _mm.message("\n** Main loop exited...");
+}
+
+void RobotStack::shutdown() {
+  if (!_initialized) return;
+
+  // This should also deactivate other modules
+  _mm.deactivateModule( _supervisor );
+  _mm.removeModule( _supervisor );
+  delete _supervisor;
+  _supervisor = nullptr;
+  _watcher.stop();
+
+  DeactivateCoreModules( &_mm );
+  RemoveCoreModules( &_mm );
+
+  _mm.message("** Shutting down...");
+
+  cleanupHardware();
+
+#ifdef _SIMULATION_
+  _capture->close();
+  delete _capture;
+  _capture = nullptr;
+#endif
+
+  _mm.shutdown();
+  _initialized = false;
+  _instances--;
+}
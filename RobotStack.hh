@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2005-2025 Uluç Saranlı. All Rights Reserved
+ *
+ * This file is part of the RoboMETU robot control software library
+ * collection. Unauthorized copying of this file, via any medium is
+ * strictly prohibited.
+*/
+
+#ifndef _ROBOTSTACK_HH
+#define _ROBOTSTACK_HH
+
+#include <string>
+
+#include "rtcore/ModuleManager.hh"
+
+#include "ConfigWatcher.hh"
+
+class Supervisor;
+#ifdef _SIMULATION_
+class MjCapture;
+#endif
+
+/** \brief Everything that makes up one controlled robot
+
+  This class owns the ModuleManager of a robot together with its
+  configuration watcher, the core modules and the Supervisor, and brings them
+  up and down in the order main() used to. All per-robot state lives in an
+  instance, so that nothing above the hardware layer assumes a single robot
+  per process.
+
+  The hardware layer does not follow suit yet. initHardware() and
+  cleanupHardware() set up process wide state (the MuJoCo model, data and
+  viewer in simulation, the motor interfaces on the robot), and MjCapture
+  hooks the global mjcb_control callback. Only one instance can therefore be
+  initialized per process at the moment.
+ */
+class RobotStack {
+public:
+  RobotStack();
+  ~RobotStack();
+
+  /** \brief Loads the configuration and brings up hardware and modules */
+  bool init(const std::string &config);
+  /** \brief Runs the ModuleManager main loop until it is exited */
+  void run();
+  /** \brief Tears down modules and hardware in reverse order */
+  void shutdown();
+
+  rtcore::ModuleManager *getManager() { return &_mm; }
+
+private:
+  rtcore::ModuleManager _mm;
+  ConfigWatcher _watcher;
+  Supervisor *_supervisor = nullptr;
+#ifdef _SIMULATION_
+  MjCapture *_capture = nullptr;
+#endif
+  bool _initialized = false;
+
+  static int _instances;
+};
+
+#endif
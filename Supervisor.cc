@@ -7,6 +7,8 @@
 */
 
 #include <stdio.h>
+#include <sys/stat.h>
+#include <algorithm>
 #include "rtcore/ModuleManager.hh"
 #include "rtcore/LogServer.hh"
 
@@ -18,6 +20,8 @@
 #include "control_modules/MdlSit.hh"
 
 #include "Supervisor.hh"
+#include "ConfigWatcher.hh"
+#include "LogFinalizer.hh"
 
 // IMPORTANT NOTE: Be careful with enet functions since both rtcore and rtclient
 // has them separately
@@ -36,21 +40,35 @@ Supervisor::~Supervisor() {
   terminate(); 
 
   if (_logclient) {
-    delete _logclient;
+    if (!_arena.destroy(_logclient))
+      _mgr->warning("Supervisor", "Arena could not destroy the log client");
     _logclient = nullptr;
   }
 };
 
 #define LOGTHREAD_USLEEP 10000
 #define LOGTHREAD_MAX_RETRY 3
+// Closed segments that may wait for finalization before rollovers are deferred
+#define LOG_MAX_PENDING 2
+// Seconds before retrying a failed rollover
+#define LOG_SEGMENT_BACKOFF 5.0
+// Seconds between file size checks of the current segment
+#define LOG_SIZE_CHECK_PERIOD 1.0
 
 void Supervisor::threadEnter() {
   DBGPRINT("Supervisor::threadEnter\n");
 
-  bool querydone = false;
+  if (!_registerLog()) {
+    _logenable = false; 
+    setFinish(true); // Stop the thread
+  }
+}
+
+bool Supervisor::_registerLog() {
+  _logretries = 0;
 
   // Try to successfully register all variables
-  while (!querydone) {
+  while (true) {
     double t = _mgr->readTime();
 
     if (_logclient->query()) {
@@ -68,60 +86,88 @@ void Supervisor::threadEnter() {
           _logretries++;
           if (_logretries > LOGTHREAD_MAX_RETRY) {
             _mgr->warning("Supervisor", "Too many retries to register logging variables (%d). Aborting.", _logretries);
-            _logenable = false; 
-            setFinish(true); // Stop the thread
-            querydone = true;
-            break;
+            return false;
           }
           _logclient->query();
           break;
         }
       }
       if (alladded) {
-        if (_logformat == "ascii") {
-          _logwriter = new rtclient::WriteASCII(_logfile.c_str(), _logtask->varList(),
-                                                "Supervisor local data log");
-        } else if (_logformat == "raw") {
-          _logwriter = new rtclient::WriteRaw(_logfile.c_str(), _logtask->varList(),
-                                              "Supervisor local data log");
-        } else if (_logformat == "matlab") {
-          _logwriter = new rtclient::WriteML(_logfile.c_str(), _logtask->varList(),
-                                             "Supervisor local data log");
+        if (!_openWriter(t)) {
+          _mgr->warning("Supervisor", "Could not create a %s writer for %s", _logformat.c_str(),
+                        _logfile.c_str());
+          _logtask->abortLog();
+          _logtask = nullptr;
+          return false;
         }
         t = _mgr->readTime();
         _mgr->message("Supervisor: Found all variables at t=%.3f s", t);
-        querydone = true;
-        break;
+        return true;
       }
     } else {
       DBGPRINT("Supervisor: Unable to query LogServer\n");
       _logretries++;
       if (_logretries > LOGTHREAD_MAX_RETRY) {
         _mgr->warning("Supervisor", "Too many retries to register logging variables (%d). Aborting.", _logretries);
-        _logenable = false; 
-        setFinish(true); // Stop the thread
-        querydone = true;
-        break;
+        return false;
       }
+    }
+    usleep(10000);
+  }
 }
-    if (!querydone) usleep(10000);
+
+// Runs in the log thread to switch to a configuration set by _reloadConfig()
+void Supervisor::_applyLogReload() {
+  _logconfig_t log;
+  {
+    std::lock_guard<std::mutex> lock(_logmutex);
+    log = _lognext;
+    _logreload = false;
+  }
+  bool enable = log.enable && !log.vars.empty();
+
+  // Close the current log, the writer finalizes its file on destruction
+  if (_logtask) {
+    _logtask->abortLog();
+    _logtask = nullptr;
+  }
+  _closeWriter();
+  _logstarted = false;
+  _logenable = false;
+
+  _setLogConfig(log);
+
+  if (enable) {
+    if (_registerLog()) {
+      _mgr->message("Supervisor: Logging reconfigured to %s with %d variables", _segfile.c_str(),
+                    (int)_logvars.size());
+      _logenable = true;
+    } else {
+      _mgr->warning("Supervisor", "Logging disabled after configuration reload.");
+    }
   }
 }
 
 void Supervisor::threadLoop() {
+  if (_logreload) _applyLogReload();
+
   double t = _mgr->readTime();
 
   if (!_logstarted) {
-    if (_logenable) {
+    if (_logenable && _logtask) {
       if (t < _logstart) waitSync(); 
       t = _mgr->readTime();
       _mgr->message("Supervisor: Starting logging at t=%.3f s", t);
       _logtask->startLog(_logperiod, 0);
       _logstarted = true;
+      // The first segment spans from here, not from when its writer was made
+      _segstart = t;
+      _segchecked = t;
     }
   } else {
     log_line_t *d;
     while(_logtask && _logwriter && (d = _logtask->getData(0))) _logwriter->appendLine(d);
+    if (_logwriter && _segmentDue(t)) _rollSegment(t);
     if (_logtask->isDone()) {
       _logstarted = false;
       _logtask = nullptr;
@@ -139,23 +185,171 @@ void Supervisor::threadExit() {
     _logtask = nullptr;
   }
 
-  if (_logwriter) {
-    delete _logwriter;
-    _logwriter = nullptr;
+  _closeWriter();
+
+  if (_finalizer) {
+    if (!_arena.destroy(_finalizer))
+      _mgr->warning("Supervisor", "Arena could not destroy the log finalizer");
+    _finalizer = nullptr;
   }
 
   if (_logclient) {
-    delete _logclient;
+    if (!_arena.destroy(_logclient))
+      _mgr->warning("Supervisor", "Arena could not destroy the log client");
     _logclient = nullptr;
   }
+
+  // From here on, reloads restart the thread instead of handing over to it
+  std::lock_guard<std::mutex> lock(_logmutex);
+  _logrunning = false;
 }
+
+// Extension of a log file name including the dot, empty if there is none
+static std::string logExtension(const std::string &file) {
+  size_t slash = file.rfind('/');
+  size_t dot = file.rfind('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return "";
+  return file.substr(dot);
+}
+
+// Index file listing the segments of a log
+static std::string logIndex(const std::string &file) {
+  return file.substr(0, file.size() - logExtension(file).size()) + ".index";
+}
+
+// Creates the writer for the next segment, or for the whole log if it is not
+// segmented. The segment number is only used up once the writer exists.
+// Files already written during this run are never reopened, so a log
+// restarted by a configuration reload goes to the next segment, or to a
+// name_rN file when not segmented.
+bool Supervisor::_openWriter(double t) {
+  bool segmented = (_logsegsize > 0 || _logsegtime > 0);
+  size_t ext = _logfile.size() - logExtension(_logfile).size();
+  std::string segfile;
+  while (true) {
+    char num[16] = "";
+    if (segmented) snprintf(num, sizeof(num), "_%04d", _logsegment);
+    else if (_logrun > 0) snprintf(num, sizeof(num), "_r%d", _logrun);
+    segfile = _logfile.substr(0, ext) + num + _logfile.substr(ext);
+    if (!_logpaths.count(segfile)) break;
+    if (segmented) _logsegment++;
+    else _logrun++;
+  }
+
+  const char *path = segfile.c_str();
+  if (_logformat == "ascii") {
+    _logwriter = _arena.create<rtclient::WriteASCII>(path, _logtask->varList(),
+                                                     "Supervisor local data log");
+  } else if (_logformat == "raw") {
+    _logwriter = _arena.create<rtclient::WriteRaw>(path, _logtask->varList(),
+                                                   "Supervisor local data log");
+  } else if (_logformat == "matlab") {
+    _logwriter = _arena.create<rtclient::WriteML>(path, _logtask->varList(),
+                                                  "Supervisor local data log");
+  }
+
+  if (!_logwriter) return false;
+  _logpaths.insert(segfile);
+
+  if (_logsegsize > 0 || _logsegtime > 0) {
+    // Segment files of earlier runs were just overwritten or will be, so
+    // their index entries go as well
+    if (_logsegment == 0) {
+      FILE *f = fopen(logIndex(_logfile).c_str(), "w");
+      if (f) fclose(f);
+      else _mgr->warning("Supervisor", "Could not reset %s", logIndex(_logfile).c_str());
+    }
+    _logsegment++;
+  }
+  _segfile = segfile;
+  _segstart = t;
+  _segbytes = 0;
+  _segchecked = t;
+  return true;
+}
+
+LogFinalizer::segment_t Supervisor::_segment(double tend) {
+  LogFinalizer::segment_t seg;
+  seg.writer = _logwriter;
+  seg.file = _segfile;
+  seg.index = logIndex(_logfile);
+  seg.tstart = _segstart;
+  seg.tend = tend;
+  seg.compress = _logcompress;
+  return seg;
+}
+
+bool Supervisor::_segmentDue(double t) {
+  if (t < _segretry) return false;
+  if (_logsegtime > 0 && t - _segstart >= _logsegtime) return true;
+  if (_logsegsize > 0) {
+    if (t - _segchecked >= LOG_SIZE_CHECK_PERIOD) {
+      // Only the file system knows, so ask it rarely
+      struct stat st;
+      if (stat(_segfile.c_str(), &st) == 0) _segbytes = st.st_size;
+      _segchecked = t;
+    }
+    if (_segbytes >= _logsegsize * 1024 * 1024) return true;
+  }
+  return false;
+}
+
+// Switches to a new segment and leaves closing the previous one to the
+// finalizer thread, so that draining samples only pays for opening a file
+bool Supervisor::_rollSegment(double t) {
+  if (!_finalizer || _finalizer->pending() >= LOG_MAX_PENDING) return false;
+
+  LogFinalizer::segment_t seg = _segment(t);
+  _logwriter = nullptr;
+
+  if (!_openWriter(t)) {
+    // Keep writing to the current segment and try again later
+    _logwriter = seg.writer;
+    _segretry = t + LOG_SEGMENT_BACKOFF;
+    _mgr->warning("Supervisor", "Could not start a new log segment, continuing %s",
+                  _segfile.c_str());
+    return false;
+  }
+  _finalizer->push(seg);
+  return true;
+}
+
+void Supervisor::_closeWriter() {
+  // Segments also get indexed, in order after those still being finalized
+  if (_finalizer && _logwriter && (_logsegsize > 0 || _logsegtime > 0)) {
+    _finalizer->push(_segment(_mgr->readTime()));
+    _logwriter = nullptr;
+    _finalizer->wait();
+    return;
+  }
+
+  // The writer finalizes its output on destruction
+  if (_logwriter) {
+    if (!_arena.destroy(_logwriter))
+      _mgr->warning("Supervisor", "Arena could not destroy the log writer");
+    _logwriter = nullptr;
+  }
+}
+
 void Supervisor::init() {
   DBGPRINT("Supervisor::init\n");
   
   // LogClient does not do its own enet initialization, so we must do it here
   rtclient::enet_initialize();
 
-  MdlSit *SitModule = new MdlSit();
+  // Reserve room for everything the supervisor creates: the sit module, the
+  // log client, the segment finalizer, and log writers for the current
+  // segment and those waiting to be finalized, plus one spare against
+  // fragmentation
+  size_t writersize = std::max({ sizeof(rtclient::WriteASCII), sizeof(rtclient::WriteRaw),
+                                 sizeof(rtclient::WriteML) });
+  if (!_arena.reserve(ModuleArena::footprint(sizeof(MdlSit))
+                      + ModuleArena::footprint(sizeof(rtclient::LogClient))
+                      + ModuleArena::footprint(sizeof(LogFinalizer))
+                      + (LOG_MAX_PENDING + 2) * ModuleArena::footprint(writersize)))
+    _mgr->fatalError("Supervisor", "Could not reserve module arena");
+
+  MdlSit *SitModule = _arena.create<MdlSit>();
   _mgr->addModule(SitModule, 1, 0, USER_CONTROLLERS);
 
   _logserver = (LogServer*) _mgr->findModule(LOGSERVER_NAME, 0);
@@ -164,8 +358,22 @@ void Supervisor::init() {
     _mgr->warning("Supervisor", "Failed to find module %s", SITMODULE_NAME);
   }
 
+  _readConfig(_logconfig, _mgr);
+  _setLogConfig(_logconfig);
+  _startLogging();
+
+  ConfigTable config;
+  if (_watcher && (!_mgr->getConfigTable("supervisor", config) || config.getBool("hot_reload", true)))
+    _watcher->watch();
+}
+
+// Reads supervisor parameters from the given configuration database, which is
+// either the ModuleManager's own or one staged by the ConfigWatcher
+void Supervisor::_readConfig(_logconfig_t &log, ModuleManager *db) {
+  log = _logconfig_t();
+
   ConfigTable config;
-  bool hasConfig = _mgr->getConfigTable("supervisor", config);
+  bool hasConfig = db->getConfigTable("supervisor", config);
 
   if (hasConfig) {
     _exitTime = config.getDouble("exit_time", 0.0);
@@ -174,18 +382,16 @@ void Supervisor::init() {
     ConfigTable logconfig;
     bool hasLog = config.getTable("log", logconfig);
     if (hasLog) {
-      bool logenable_config = logconfig.getBool("enable", false);
-      _logstart = logconfig.getDouble("start", 0.0);
-      _logfile = logconfig.getString("file_name", "supervisor.log");
-      _logperiod = logconfig.getInt("period", 1);
-      _logformat = logconfig.getString("file_format", "ascii");
-      if (_logformat != "ascii" && _logformat != "raw" && _logformat != "matlab") {
-        DBGPRINT("Supervisor: Unknown log format '%s'. Using 'ascii'.\n", _logformat.c_str());
-        _logformat = "ascii";
+      log.enable = logconfig.getBool("enable", false);
+      log.start = logconfig.getDouble("start", 0.0);
+      log.file = logconfig.getString("file_name", "supervisor.log");
+      log.period = logconfig.getInt("period", 1);
+      log.format = logconfig.getString("file_format", "ascii");
+      if (log.format != "ascii" && log.format != "raw" && log.format != "matlab") {
+        DBGPRINT("Supervisor: Unknown log format '%s'. Using 'ascii'.\n", log.format.c_str());
+        log.format = "ascii";
       }
 
-      _logvars.clear();
-
       // Read and process list of variables to log
       ConfigArray logvars;
       if (logconfig.getArray("vars", logvars)) {
@@ -193,7 +399,7 @@ void Supervisor::init() {
           std::string varname = logvars.getStringAt(i);
           if (!varname.empty()) {
             DBGPRINT("Supervisor: Adding variable %s to logging task.\n", varname.c_str());
-            _logvars.push_back(varname);
+            log.vars.push_back(varname);
           } else {
             DBGPRINT("Supervisor: Empty variable name at index %d\n", i);
           }
@@ -202,16 +408,12 @@ void Supervisor::init() {
         DBGPRINT("Supervisor: No variables specified for logging.\n");
       }
 
-      _logenable = false; // Disable until all parameters check out
-      if (logenable_config && _logvars.size() != 0) {
-        _mgr->message("Supervisor: Logging enabled to %s with %d variables", _logfile.c_str(), 
-                      (int)_logvars.size());
-        _logclient = new rtclient::LogClient("localhost", _logserver->getPort(), _logserver->getChannel());
-        if (_logclient) {
-          _logenable = true;
-          _logstarted = false;
-          start( "locallog", 0 ); // Start logging at low priority
-        }
+      // Segmentation options
+      ConfigTable segconfig;
+      if (logconfig.getTable("segment", segconfig)) {
+        log.segsize = segconfig.getDouble("size_mb", 0.0);
+        log.segtime = segconfig.getDouble("duration", 0.0);
+        log.compress = segconfig.getBool("compress", false);
       }
     } else {
       DBGPRINT("Supervisor: No logging configuration found.\n");
@@ -219,17 +421,102 @@ void Supervisor::init() {
   }
 }
 
+void Supervisor::_setLogConfig(const _logconfig_t &log) {
+  // Numbering starts over for a different file, _openWriter() skips names
+  // already written
+  if (log.file != _logfile) {
+    _logsegment = 0;
+    _logrun = 0;
+  }
+  _logstart = log.start;
+  _logperiod = log.period;
+  _logfile = log.file;
+  _logformat = log.format;
+  _logvars = log.vars;
+  _logsegsize = log.segsize;
+  _logsegtime = log.segtime;
+  _logcompress = log.compress;
+}
+
+void Supervisor::_startLogging() {
+  _logenable = false; // Disable until all parameters check out
+  if (_logconfig.enable && _logvars.size() != 0) {
+    _mgr->message("Supervisor: Logging enabled to %s with %d variables", _logfile.c_str(), 
+                  (int)_logvars.size());
+    _logclient = _arena.create<rtclient::LogClient>("localhost", _logserver->getPort(),
+                                                    _logserver->getChannel());
+    if (!_finalizer) _finalizer = _arena.create<LogFinalizer>(_mgr, &_arena);
+    if (_logclient) {
+      _logenable = true;
+      _logstarted = false;
+      _logrunning = true;
+      setFinish(false); // Cleared in case an earlier log thread gave up
+      start( "locallog", 0 ); // Start logging at low priority
+    }
+  }
+}
+
+void Supervisor::_reloadConfig(ModuleManager *db) {
+  double t = _mgr->readTime();
+  _mgr->message("Supervisor: Reloading configuration at t=%.3f s", t);
+
+  _logconfig_t log;
+  _readConfig(log, db);
+
+  if (_wm) _wm->reloadConfig(db);
+
+  if (log.enable == _logconfig.enable && log.start == _logconfig.start
+      && log.period == _logconfig.period && log.file == _logconfig.file
+      && log.format == _logconfig.format && log.vars == _logconfig.vars
+      && log.segsize == _logconfig.segsize
+      && log.segtime == _logconfig.segtime && log.compress == _logconfig.compress)
+    return;
+  _logconfig = log;
+
+  {
+    // A running log thread switches over between two drains
+    std::lock_guard<std::mutex> lock(_logmutex);
+    if (_logrunning) {
+      _lognext = log;
+      _logreload = true;
+      return;
+    }
+  }
+  _restartLogging(log);
+}
+
+// Starts a new log thread once the previous one has exited, e.g. after it
+// failed to register variables that a reload has now corrected
+void Supervisor::_restartLogging(const _logconfig_t &log) {
+  terminate(); // Joins the exited thread, which has released its resources
+  _setLogConfig(log);
+  _startLogging();
+}
+
 void Supervisor::uninit() {
   DBGPRINT("Supervisor::uninit\n");
 
+  if (_watcher) _watcher->stop();
+
+  // Stop the logging thread first so that it no longer uses arena objects
+  terminate();
+
   if (_wm) {
     _mgr->deactivateModule(_wm);
     _mgr->removeModule(_wm);
-    delete _wm;
+    if (!_arena.destroy(_wm))
+      _mgr->warning("Supervisor", "Arena could not destroy the sit module");
     _wm = nullptr;
   }
 
-  terminate();
+  ModuleArena::usage_t usage = _arena.getUsage();
+  _mgr->message("Supervisor: arena used %zu of %zu bytes (peak %zu) in %u allocations",
+                usage.used, usage.capacity, usage.peak, usage.total);
+
+  _arena.release();
+  _logwriter = nullptr;
+  _finalizer = nullptr;
+  _logclient = nullptr;
 }
 
 void Supervisor::activate() {
@@ -252,6 +539,23 @@ void Supervisor::deactivate() {
 }
 
 void Supervisor::update() {
+  // Apply configuration changes before anything else uses them this tick
+  ModuleManager *db;
+  if (_watcher && (db = _watcher->acquire())) {
+    _reloadConfig(db);
+    _watcher->release();
+  }
+  // A configuration handed over just as the log thread exited
+  if (_logreload && !_logrunning) {
+    _logconfig_t log;
+    {
+      std::lock_guard<std::mutex> lock(_logmutex);
+      log = _lognext;
+      _logreload = false;
+    }
+    _restartLogging(log);
+  }
+
   double t = _mgr->readTime();
 
   // Print current time every second
@@ -9,6 +9,11 @@
 #ifndef _SUPERVISOR_HH
 #define _SUPERVISOR_HH
 
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+
 #include "rtcore/Module.hh"
 #include "rtcore/LogServer.hh"
 #include "rtcore/ThreadedLoop.hh"
@@ -16,7 +21,12 @@
 #include "rtclient/LogClient.hh"
 #include "rtclient/LogWriter.hh"
 
+#include "control_modules/ModuleArena.hh"
+
+#include "LogFinalizer.hh"
+
 class MdlSit;
+class ConfigWatcher;
 
 /** \brief Top-level supervisor module for quadruped control
 
@@ -29,7 +39,16 @@ class MdlSit;
   perform local logging of data variables to a file, primarily intended for
   simulation environments. Various components of this logging system can be
   configured through the supervisor.log table entry in the global ModuleManager
-  configuration database.
+  configuration database. With supervisor.log.segment, the log is split into
+  numbered, independently loadable files once a size or duration limit is
+  reached, which are finalized in the background by a LogFinalizer and listed
+  in an index file.
+
+  When given a ConfigWatcher, the supervisor picks up the configuration
+  database the watcher has parsed after the watched files change, at the
+  start of its update. The exit time and the logging setup are then reapplied, with the logging
+  thread re-registering variables without being restarted, and MdlSit picks
+  up its new parameters. Setting supervisor.hot_reload to false disables this.
 
   See supervisor.toml file for configuration options and default values.
 
@@ -45,12 +64,41 @@ public:
   void deactivate();
   void update();
 
+  /** \brief Enables configuration reloads, must be called before init() */
+  void setConfigWatcher(ConfigWatcher *watcher) { _watcher = watcher; }
+
   // The threaded loop is for local logging
   void threadEnter();
   void threadLoop();
   void threadExit();
 
 private:
+  /** \brief Logging configuration as read from supervisor.log */
+  typedef struct {
+    bool enable = false;
+    double start = 0;
+    unsigned int period = 1;
+    std::string file = "supervisor.log";
+    std::string format = "ascii";
+    std::vector<std::string> vars;
+    double segsize = 0;          // Segment size limit in MB, 0 for none
+    double segtime = 0;          // Segment duration limit in seconds, 0 for none
+    bool compress = false;       // Compress closed segments with gzip
+  } _logconfig_t;
+
+  void _readConfig(_logconfig_t &log, rtcore::ModuleManager *db);
+  void _setLogConfig(const _logconfig_t &log);
+  void _reloadConfig(rtcore::ModuleManager *db);
+  void _startLogging();
+  bool _registerLog();
+  void _applyLogReload();
+  void _closeWriter();
+  void _restartLogging(const _logconfig_t &log);
+  bool _openWriter(double t);
+  bool _rollSegment(double t);
+  bool _segmentDue(double t);
+  LogFinalizer::segment_t _segment(double tend);
+
   /** \brief Possible states for the supervisory state machine */
   typedef enum { S_INIT, S_WALK, S_EXIT } _state_t;
   /** \brief Current state */
@@ -75,10 +123,37 @@ private:
   std::string _logformat = "ascii";
   // List of variables configured through supervisor.log.vars
   std::vector<std::string> _logvars;
+  // Segmentation settings from supervisor.log.segment
+  double _logsegsize = 0;
+  double _logsegtime = 0;
+  bool _logcompress = false;
+  // Current segment
+  int _logsegment = 0;
+  int _logrun = 0;          // Restarts of an unsegmented log, see _openWriter()
+  std::set<std::string> _logpaths; // Log files written during this run
+  std::string _segfile;
+  double _segstart = 0;
+  size_t _segbytes = 0;     // Last known size of the segment
+  double _segchecked = 0;   // Time of the last size check
+  double _segretry = 0;     // No rollover before this time after a failure
 
   rtclient::LogClient *_logclient = nullptr;
   rtclient::LogTask   *_logtask = nullptr;
   rtclient::LogWriter *_logwriter = nullptr;
+  LogFinalizer *_finalizer = nullptr;
+
+  // Configuration reload support. _logconfig is the last configuration read
+  // by the main thread, _lognext hands a changed one over to the log thread.
+  ConfigWatcher *_watcher = nullptr;
+  _logconfig_t _logconfig;
+  _logconfig_t _lognext;
+  std::mutex _logmutex;
+  std::atomic<bool> _logreload{ false };
+  std::atomic<bool> _logrunning{ false }; // Log thread started and not yet exited
+
+  // Storage for the behavior modules and logging components created above,
+  // reserved in init() and released in uninit()
+  ModuleArena _arena;
 };
 
 #endif
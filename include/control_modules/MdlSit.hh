@@ -5,11 +5,15 @@
 
 #include "Eigen/Dense"
 
+#include "control_modules/ModuleArena.hh"
+#include "control_modules/MultiRateTargets.hh"
+
 class MdlLegControl;
 class QuadrupedKinematics;
 
 namespace rtcore {
 class Profiler;
+class ModuleManager;
 }
 
 #define SITMODULE_NAME "MdlSit"
@@ -25,8 +29,15 @@ public:
   void deactivate();
   void update();
 
+  /** \brief Rereads parameters from the sit configuration table of db, or
+      of the ModuleManager if nullptr. Changed poses take effect through a new
+      transition when the module is active. */
+  void reloadConfig(rtcore::ModuleManager *db = nullptr);
 
 private:
+  void _behaviorUpdate(double t);
+  void _sendInterpolated(double t);
+
   bool _wait_done(double t);
   bool _sit_done(double t);
   bool _transition_done(double t);
@@ -34,6 +45,8 @@ private:
   void _wait_entry();
   void _wait_during();
   void _wait_exit();
+  void _moveStance();
+  void _computeStance();
   
 
   void _sendTarget();
@@ -50,11 +63,19 @@ private:
   void _transition_entry();
   void _transition_during();
   void _transition_exit();
+  void _setSitGoal();
 
   enum class _state_t { WAIT, TRANSITION, SIT, DONE };
   _state_t _state = _state_t::WAIT;
 
+  bool _active = false;
+  bool _standmove = false; // Feet moving to a reloaded stance during WAIT
   double _mark = 0.0;
+  double _now = 0.0; // Time of the current behavior update
+
+  // Behavior update rate in Hz from sit.update_rate, 0 for every tick
+  double _update_rate = 0.0;
+  MultiRateTargets _targets;
 
   Eigen::Vector3d _footpos[4];
   Eigen::Vector3d _footvel[4];
@@ -63,10 +84,17 @@ private:
   MdlLegControl *_legs[4];
   QuadrupedKinematics *_kinematics = nullptr;
 
+  // Parameters from the sit configuration table
   double _origin[3] = {-0.05, 0.12, -0.26};
+  double _sitpose[3] = {0.3, 0.9, -2.5};
+  double _wait_time = 3.0;
+  double _transition_time = 7.0;
 
   rtcore::Profiler *_profiler[3][4];
 
+  // Holds the kinematics and profiler instances between init() and uninit()
+  ModuleArena _arena;
+
   Eigen::Vector3d _footsitangle[4];
   Eigen::Vector3d _footsitangledot[4];
 
@@ -0,0 +1,150 @@
+#ifndef MODULEARENA_HH
+#define MODULEARENA_HH
+
+#include <stddef.h>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+#include <type_traits>
+
+// All arena allocations start on a cache line boundary
+#define ARENA_ALIGN 64
+
+/** \brief Module-scoped arena for behavior module resources
+
+  A ModuleArena owns a single contiguous, cache line aligned block of memory
+  that a module reserves once in its init() and uses for the objects it would
+  otherwise scatter over the heap with new. All objects still alive are
+  destroyed in reverse order of creation by release(), which modules call from
+  their uninit(), after which the block is rewound and reused by the next
+  init().
+
+  Objects can also be destroyed individually with destroy(). Their slots are
+  reused by later allocations that fit, so objects recreated repeatedly while
+  the module is running do not grow the arena. Allocations that do not fit in
+  the reserved block fail and return nullptr.
+
+  Allocation and destruction are serialized with an internal mutex, since the
+  owning module and its threads may both create objects. Destructors run
+  without the mutex held, both in destroy() and release(), so that they may
+  themselves use the arena or wait on threads that do. All of this is meant
+  for init/uninit-time use, not for the control loop.
+ */
+class ModuleArena {
+public:
+  /** \brief Usage statistics as returned by getUsage() */
+  typedef struct {
+    size_t capacity;     // Size of the reserved block in bytes
+    size_t used;         // Bytes currently held by live objects
+    size_t peak;         // High watermark of used
+    unsigned int live;   // Number of live allocations
+    unsigned int total;  // Number of allocations since the last release()
+    unsigned int failed; // Number of allocations that did not fit
+  } usage_t;
+
+  ModuleArena();
+  ~ModuleArena();
+
+  /** \brief Reserves and prefaults a block of at least capacity bytes.
+      Does nothing if the current block is already large enough. Fails if
+      the arena still holds live objects and would have to be moved. */
+  bool reserve(size_t capacity);
+  /** \brief Destroys all live objects in reverse order and rewinds the arena.
+      The block itself is kept for subsequent allocations. */
+  void release();
+
+  /** \brief Constructs a T in the arena, returns nullptr if it does not fit */
+  template <class T, class... Args> T *create(Args &&...args) {
+    static_assert(alignof(T) <= ARENA_ALIGN, "ModuleArena: over-aligned type");
+    void *p = _allocate(sizeof(T));
+    if (!p) return nullptr;
+    T *obj;
+    try {
+      obj = new (p) T(std::forward<Args>(args)...);
+    } catch (...) {
+      _abandon(p);
+      throw;
+    }
+    _commit(p, 1, std::is_trivially_destructible<T>::value ? nullptr : &_destroyAll<T>);
+    return obj;
+  }
+
+  /** \brief Default constructs a contiguous array of n T objects */
+  template <class T> T *createArray(size_t n) {
+    static_assert(alignof(T) <= ARENA_ALIGN, "ModuleArena: over-aligned type");
+    void *p = _allocate(n * sizeof(T));
+    if (!p) return nullptr;
+    T *arr = static_cast<T *>(p);
+    size_t i = 0;
+    try {
+      for (; i < n; i++) new (&arr[i]) T();
+    } catch (...) {
+      _destroyAll<T>(arr, i);
+      _abandon(p);
+      throw;
+    }
+    _commit(p, n, std::is_trivially_destructible<T>::value ? nullptr : &_destroyAll<T>);
+    return arr;
+  }
+
+  /** \brief Destroys an object or array previously obtained from this arena.
+      obj may point to a base class of the created object, polymorphic ones
+      are mapped back to the start of the complete object. Returns false, and
+      destroys nothing, if that is not a live allocation of this arena. */
+  template <class T> bool destroy(T *obj) {
+    return _destroy(_objectStart(obj, std::is_polymorphic<T>()));
+  }
+
+  /** \brief Checks whether p points into the reserved block */
+  bool owns(const void *p) const;
+  usage_t getUsage() const;
+
+  /** \brief Arena bytes taken by an allocation of the given size */
+  static constexpr size_t footprint(size_t size) {
+    return (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+  }
+
+private:
+  typedef void (*_dtor_t)(void *ptr, size_t count);
+
+  typedef struct {
+    size_t offset;  // Start of the slot within the block
+    size_t size;    // Slot size, always a multiple of ARENA_ALIGN
+    size_t count;   // Number of objects constructed in the slot
+    _dtor_t dtor;   // Destructor, nullptr for trivially destructible types
+    bool live;
+    bool dying;     // Destructor running, no longer available to destroy()
+  } _slot_t;
+
+  template <class T> static void _destroyAll(void *ptr, size_t count) {
+    T *arr = static_cast<T *>(ptr);
+    while (count > 0) arr[--count].~T();
+  }
+
+  template <class T> static void *_objectStart(T *obj, std::true_type) {
+    return obj ? dynamic_cast<void *>(obj) : nullptr;
+  }
+  template <class T> static void *_objectStart(T *obj, std::false_type) {
+    return (void *)obj;
+  }
+
+  bool _destroy(void *obj);
+  int _lastLive() const;
+  void *_allocate(size_t size);
+  void _commit(void *p, size_t count, _dtor_t dtor);
+  void _abandon(void *p);
+  int _findSlot(const void *p) const;
+  void _freeSlot(int idx);
+
+  mutable std::mutex _mutex;
+  char *_block = nullptr;
+  size_t _top = 0;
+  std::vector<_slot_t> _slots;
+  usage_t _usage;
+
+  ModuleArena(const ModuleArena &) = delete;
+  ModuleArena &operator=(const ModuleArena &) = delete;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef MULTIRATETARGETS_HH
+#define MULTIRATETARGETS_HH
+
+#include "Eigen/Dense"
+
+/** \brief Leg targets for behaviors running slower than the leg controllers
+
+  A behavior module that declares an update rate through setRate() only
+  recomputes its state machine and targets when due() returns true, and hands
+  the resulting foot positions or joint angles together with their velocities
+  to setTargets(). On every control tick, getTargets() then supplies the
+  targets to send to the leg controllers.
+
+  Each new sample starts a cubic Hermite segment from the currently commanded
+  position and velocity to where the sample's velocity feed-forward predicts
+  the target one update period later, so commands stay continuous in position
+  and velocity at the full leg control rate. If the behavior misses an update,
+  targets are extrapolated for at most one more period and then held.
+
+  A rate of 0 runs the behavior on every tick and passes targets through
+  unchanged.
+ */
+class MultiRateTargets {
+public:
+  /** \brief Kind of targets currently held */
+  typedef enum { T_NONE, T_FOOT, T_JOINT } target_t;
+
+  MultiRateTargets();
+
+  /** \brief Sets the behavior update rate in Hz, 0 for every tick */
+  void setRate(double rate);
+  double getRate() const { return _rate; }
+
+  /** \brief Drops held targets and makes the next due() call succeed */
+  void reset();
+  /** \brief Whether the behavior should be updated at time t */
+  bool due(double t);
+
+  /** \brief Records new targets for all four legs computed at time t */
+  void setTargets(target_t type, double t, const Eigen::Vector3d pos[4],
+                  const Eigen::Vector3d vel[4]);
+  /** \brief Evaluates the targets to command at time t */
+  target_t getTargets(double t, Eigen::Vector3d pos[4], Eigen::Vector3d vel[4]) const;
+
+private:
+  double _rate = 0;
+  double _period = 0;
+  double _next = 0;
+  bool _pending = true;
+
+  target_t _type = T_NONE;
+  double _t0 = 0;
+  // Segment start and end states for each leg
+  Eigen::Vector3d _p0[4], _v0[4];
+  Eigen::Vector3d _p1[4], _v1[4];
+};
+
+#endif
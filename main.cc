@@ -11,15 +11,9 @@
 #include <signal.h>
 #include <getopt.h>
 
-#include "rtcore/Module.hh"
-#include "rtcore/ThreadUtil.hh"
 #include "rtcore/ModuleManager.hh"
-#include "rtcore/ConfigTable.hh"
 
-#include "hardware/MotorHW.hh"
-#include "quadruped/CoreModules.hh"
-
-#include "Supervisor.hh"
+#include "RobotStack.hh"
 
 using namespace rtcore;
 
@@ -71,10 +65,10 @@ int main( int argc, char **argv) {
     }
   }
 
-  ModuleManager mm;
+  RobotStack stack;
 
   // This is so that the Ctrl-C signal handler can access the module manager.
-  _mgr = &mm;
+  _mgr = stack.getManager();
   
   signal( SIGINT, exit_on_ctrl_c );
   signal( SIGTERM, exit_on_ctrl_c );
@@ -84,57 +78,11 @@ int main( int argc, char **argv) {
     printf("Custom configuration string:\n%s", config_string.c_str());
   }
 
-  mm.clearConfig();
-  bool res;
-  res = mm.appendConfigFile("list.toml");
-  res = res && mm.appendConfigFile("versionlist.toml");
-  res = res && mm.appendConfigFile("robotlist.toml");
-  if (!mm.appendConfigFile("localoverrides.toml")) {
-    mm.warning("main", "Could not find localoverrides.toml, skipping");
-  }
-  res = res && mm.appendConfigString(config_string.c_str());
-  if (!res) mm.fatalError( "main", "Could not find one or more configuration files!");
-  if (! mm.finalizeConfig() )
-    mm.fatalError( "main", "Error readingconfiguration files!");
-
-  //printf("*** CURRENT CONFIG ***\n");
-  //mm.getConfigRoot()->print();
-  //printf("**********************\n");
+  if (!stack.init(config_string))
+    _mgr->fatalError( "main", "Error reading configuration files!");
 
-  initHardware( &mm );
-  
-  AddCoreModules( &mm );
-  ActivateCoreModules( &mm );
-
-  // This activates the supervisor, which in turn activates other modules
-  Supervisor *sm = new Supervisor;
-  mm.addModule(sm, 1, 0, USER_CONTROLLERS);
-  mm.activateModule( sm );
-
-  mm.message("\n** Current list of modules:");
-  mm.printModules();
-  mm.message("\n** Current list of threads:");
-  ThreadUtil::printThreads();
-
-  //mm.setStepPeriod( 2000 ); // OPTIONAL: Sets the update period to 1ms = 1000us
-  mm.message("\n** Entering main loop...");
-  mm.mainLoop();
-  mm.message("\n** Main loop exited...");
-  
-  // This should also deactivate other modules
-  mm.deactivateModule( sm );
-  mm.removeModule( sm );
-  delete sm;
-
-  DeactivateCoreModules( &mm );
-  RemoveCoreModules( &mm );
-  
-  mm.message("** Shutting down...");
-
-  cleanupHardware();
-
-  mm.shutdown();
+  stack.run();
+  stack.shutdown();
 
   return 0;
 }
-
@@ -1,5 +1,6 @@
 #include "control_modules/MdlSit.hh"
 #include "rtcore/ModuleManager.hh"
+#include "rtcore/ConfigTable.hh"
 #include "rtcore/Profiler.hh"
 #include <quadruped/MdlLegControl.hh>
 #include <quadruped/QuadrupedKinematics.hh>
@@ -28,18 +29,99 @@ void MdlSit::init() {
   for (int l = 0; l < 4; l++)
     _legs[l] = (MdlLegControl *)_mgr->findModule(LEGMODULE_NAME, l);
 
-  _kinematics = new QuadrupedKinematics(createGo2Config());
+  _arena.reserve(ModuleArena::footprint(sizeof(QuadrupedKinematics))
+                 + ModuleArena::footprint(12 * sizeof(Profiler)));
+
+  _kinematics = _arena.create<QuadrupedKinematics>(createGo2Config());
+  Profiler *profilers = _arena.createArray<Profiler>(12);
+  if (!_kinematics || !profilers)
+    _mgr->fatalError("MdlSit", "Could not allocate module resources");
 
   for (int i = 0; i < 3; i++){
     for (int j = 0; j < 4; j++){
-      _profiler[i][j] = new Profiler();
+      _profiler[i][j] = &profilers[4 * i + j];
     }
   }
 
+  reloadConfig();
+}
+
+void MdlSit::reloadConfig(ModuleManager *db) {
+  double origin[3] = { _origin[0], _origin[1], _origin[2] };
+  double sitpose[3] = { _sitpose[0], _sitpose[1], _sitpose[2] };
+  double transition_time = _transition_time;
+
+  ConfigTable config;
+  if ((db ? db : _mgr)->getConfigTable("sit", config)) {
+    _update_rate = config.getDouble("update_rate", 0.0);
+    _wait_time = config.getDouble("wait_time", 3.0);
+    _transition_time = config.getDouble("transition_time", 7.0);
+
+    // Standing foot position relative to the hips
+    ConfigTable stand;
+    if (config.getTable("stand", stand)) {
+      _origin[0] = stand.getDouble("x", -0.05);
+      _origin[1] = stand.getDouble("y", 0.12);
+      _origin[2] = stand.getDouble("z", -0.26);
+    }
+    // Sitting joint angles in radians
+    ConfigTable pose;
+    if (config.getTable("pose", pose)) {
+      _sitpose[0] = pose.getDouble("abduction", 0.3);
+      _sitpose[1] = pose.getDouble("hip", 0.9);
+      _sitpose[2] = pose.getDouble("knee", -2.5);
+    }
+  }
+
+  if (_update_rate != _targets.getRate()) {
+    _targets.setRate(_update_rate);
+    if (_update_rate > 0)
+      _mgr->message("MdlSit: Updating behavior at %.1f Hz", _update_rate);
+  }
+
+  if (!_active) return;
+
+  // Move to changed poses from wherever the legs are now being commanded
+  bool newstand = false, newsit = false;
+  for (int i = 0; i < 3; i++) {
+    newstand = newstand || origin[i] != _origin[i];
+    newsit = newsit || sitpose[i] != _sitpose[i];
+  }
+  switch (_state) {
+  case _state_t::WAIT:
+    if (newstand) {
+      _now = _mgr->readTime();
+      _moveStance();
+    }
+    break;
+  case _state_t::TRANSITION:
+  case _state_t::SIT:
+    if (newsit || (_state == _state_t::TRANSITION && transition_time != _transition_time)) {
+      for (int i = 0; i < 4; i++)
+        _current_angles[i] = _footsitangle[i];
+      _setSitGoal();
+      _state = _state_t::TRANSITION;
+      _now = _mgr->readTime();
+      _transition_entry();
+    }
+    break;
+  case _state_t::DONE:
+    break;
+  }
 }
 
 void MdlSit::uninit() {
   DBGPRINT("MdlSit::uninit\n");
+
+  ModuleArena::usage_t usage = _arena.getUsage();
+  _mgr->message("MdlSit: arena used %zu of %zu bytes (peak %zu) in %u allocations",
+                usage.used, usage.capacity, usage.peak, usage.total);
+
+  _arena.release();
+  _kinematics = nullptr;
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 4; j++)
+      _profiler[i][j] = nullptr;
 }
 
 void MdlSit::activate() {
@@ -49,51 +131,83 @@ void MdlSit::activate() {
 
   _state = _state_t::WAIT;
   _mark = _mgr->readTime();
+  _now = _mark;
+  _targets.reset();
+  _active = true;
   _wait_entry();
 }
 
 void MdlSit::deactivate() {
   DBGPRINT("MdlSit::deactivate\n");
+  _active = false;
 
   for (int i = 0; i < 4; i++)
     _mgr->releaseModule(_legs[i], this);
 }
 
 bool MdlSit::_wait_done(double t) {
-  return (t - _mark > 3);
+  return (t - _mark > _wait_time);
 }
 
 bool MdlSit::_transition_done(double t) {
-  return (t - _mark > 7);
+  return (t - _mark > _transition_time);
 }
 
 void MdlSit::_wait_entry() {
+  _standmove = false;
   _setTargetInit();
 }
 
 void MdlSit::_wait_during() {
+  if (_standmove) _computeStance();
   _sendTarget();
 }
 
+// Profiles the feet from their commanded positions to a changed stance over
+// the wait time, which restarts so that sitting begins once they arrive
+void MdlSit::_moveStance() {
+  Eigen::Vector3d start[4] = { _footpos[0], _footpos[1], _footpos[2], _footpos[3] };
+  _setTargetInit();
+
+  _mark = _now;
+  for (int j = 0; j < 4; j++) {
+    for (int i = 0; i < 3; i++) {
+      _profiler[i][j]->clear();
+      _profiler[i][j]->add(0.0, start[j][i]);
+      _profiler[i][j]->add(_wait_time, _footpos[j][i]);
+    }
+    _footpos[j] = start[j];
+  }
+  _standmove = true;
+}
+
+void MdlSit::_computeStance() {
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++) {
+      Profiler::fval_t val;
+      _profiler[i][j]->value(_now - _mark, val);
+      _footpos[j][i] = val.v;
+      _footvel[j][i] = val.d;
+    }
+  }
+  if (_now - _mark >= _wait_time) _standmove = false;
+}
+
 void MdlSit::_wait_exit() {
-  _setTargetAngle();
-  _fangle.push_back(Eigen::Vector3d(_footsitangle[0][0], _footsitangle[0][1], _footsitangle[0][2]));
-  _fangle.push_back(Eigen::Vector3d(_footsitangle[1][0], _footsitangle[1][1], _footsitangle[1][2]));
-  _fangle.push_back(Eigen::Vector3d(_footsitangle[2][0], _footsitangle[2][1], _footsitangle[2][2]));
-  _fangle.push_back(Eigen::Vector3d(_footsitangle[3][0], _footsitangle[3][1], _footsitangle[3][2]));
+  _setSitGoal();
   _getCurrentAngles();
   DBGPRINT("current angles are obtained");
 }
 
 
 void MdlSit::_transition_entry() {
-  _mark = _mgr->readTime();
+  _mark = _now;
 
   for (int j = 0; j < 4; j++){
     for (int i = 0; i < 3; i++) {
       _profiler[i][j]->clear();
       _profiler[i][j]->add(0.0, _current_angles[j][i]);
-      _profiler[i][j]->add(7.0, _fangle[j][i]);
+      _profiler[i][j]->add(_transition_time, _fangle[j][i]);
     }
   }
 }
@@ -105,6 +219,15 @@ void MdlSit::_transition_during() {
 
 void MdlSit::_transition_exit() {}
 
+void MdlSit::_setSitGoal() {
+  _setTargetAngle();
+  _fangle.clear();
+  _fangle.push_back(Eigen::Vector3d(_footsitangle[0][0], _footsitangle[0][1], _footsitangle[0][2]));
+  _fangle.push_back(Eigen::Vector3d(_footsitangle[1][0], _footsitangle[1][1], _footsitangle[1][2]));
+  _fangle.push_back(Eigen::Vector3d(_footsitangle[2][0], _footsitangle[2][1], _footsitangle[2][2]));
+  _fangle.push_back(Eigen::Vector3d(_footsitangle[3][0], _footsitangle[3][1], _footsitangle[3][2]));
+}
+
 void MdlSit::_sit_entry() {
   _setTargetAngle();
 }
@@ -117,7 +240,7 @@ void MdlSit::_sit_exit() {}
 
 
 void MdlSit::_computeProfile() {
-  double t = _mgr->readTime();
+  double t = _now;
 
   for (int i = 0; i < 3; i++) {
     for (int j = 0; j < 4; j++) {
@@ -132,9 +255,9 @@ void MdlSit::_computeProfile() {
 void MdlSit::_setTargetAngle() {
   for (int i = 0; i < 4; i++) {
     // Sitting joint angles (in radians)
-    _footsitangle[i][0] = 0.3 * (i % 2 == 0 ? 1 : 1);  // Hip abduction: spread legs for stability
-    _footsitangle[i][1] = 0.9;   // Hip flexion: bend hip forward significantly
-    _footsitangle[i][2] = -2.5;  // Knee: bend knee to fold leg under body
+    _footsitangle[i][0] = _sitpose[0] * (i % 2 == 0 ? 1 : 1);  // Hip abduction: spread legs for stability
+    _footsitangle[i][1] = _sitpose[1];  // Hip flexion: bend hip forward significantly
+    _footsitangle[i][2] = _sitpose[2];  // Knee: bend knee to fold leg under body
     
     _footsitangledot[i] = Eigen::Vector3d::Zero();  // No velocity
   }
@@ -142,13 +265,28 @@ void MdlSit::_setTargetAngle() {
 
 void MdlSit::_sendTargetAngle() {
   // Use angle control instead of position control
-  for (int i = 0; i < 4; i++)
-    _legs[i]->setTargetAngles(_footsitangle[i], _footsitangledot[i]);
+  _targets.setTargets(MultiRateTargets::T_JOINT, _now, _footsitangle, _footsitangledot);
 }
 
 void MdlSit::_sendTarget() {
-  for (int i = 0; i < 4; i ++)
-    _legs[i]->setTargetPosition(_footpos[i], _footvel[i]);
+  _targets.setTargets(MultiRateTargets::T_FOOT, _now, _footpos, _footvel);
+}
+
+void MdlSit::_sendInterpolated(double t) {
+  Eigen::Vector3d pos[4], vel[4];
+
+  switch (_targets.getTargets(t, pos, vel)) {
+  case MultiRateTargets::T_FOOT:
+    for (int i = 0; i < 4; i++)
+      _legs[i]->setTargetPosition(pos[i], vel[i]);
+    break;
+  case MultiRateTargets::T_JOINT:
+    for (int i = 0; i < 4; i++)
+      _legs[i]->setTargetAngles(pos[i], vel[i]);
+    break;
+  case MultiRateTargets::T_NONE:
+    break;
+  }
 }
 
 void MdlSit::_setTargetInit() {
@@ -176,6 +314,15 @@ void MdlSit::_getCurrentAngles() {
 void MdlSit::update() {
   double t = _mgr->readTime();
 
+  // The state machine runs at the configured behavior rate, targets are
+  // interpolated and sent to the legs on every tick
+  if (_targets.due(t)) _behaviorUpdate(t);
+  _sendInterpolated(t);
+}
+
+void MdlSit::_behaviorUpdate(double t) {
+  _now = t;
+
   for (int i = 0; i < 4; i++)
     _footvel[i] = Eigen::Vector3d::Zero();
 
@@ -0,0 +1,179 @@
+#include "control_modules/ModuleArena.hh"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Comment in/out beyond printf to enable/disable debug messages
+#define DBGPRINT(...) //printf(__VA_ARGS__)
+
+ModuleArena::ModuleArena() {
+  memset(&_usage, 0, sizeof(_usage));
+}
+
+ModuleArena::~ModuleArena() {
+  release();
+  if (_block) {
+    ::free(_block);
+    _block = nullptr;
+  }
+}
+
+bool ModuleArena::reserve(size_t capacity) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  capacity = footprint(capacity);
+  if (_block && capacity <= _usage.capacity) return true;
+  if (_usage.live > 0) return false;
+
+  if (_block) ::free(_block);
+  _block = (char *)aligned_alloc(ARENA_ALIGN, capacity);
+  if (!_block) {
+    _usage.capacity = 0;
+    return false;
+  }
+  // Touch every page now so that later allocations never fault
+  memset(_block, 0, capacity);
+
+  _usage.capacity = capacity;
+  _top = 0;
+  _slots.clear();
+  _slots.reserve(16);
+  DBGPRINT("ModuleArena: reserved %zu bytes\n", capacity);
+  return true;
+}
+
+void ModuleArena::release() {
+  // Destructors may themselves use the arena, so run them unlocked as in
+  // destroy(), one object at a time in reverse order of creation
+  for (;;) {
+    _slot_t s;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      int idx = _lastLive();
+      if (idx < 0) break;
+      _slots[idx].dying = true;
+      s = _slots[idx];
+    }
+    if (s.dtor) s.dtor(_block + s.offset, s.count);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _freeSlot(_findSlot(_block + s.offset));
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _slots.clear();
+  _top = 0;
+  _usage.used = 0;
+  _usage.live = 0;
+  _usage.total = 0;
+}
+
+bool ModuleArena::_destroy(void *obj) {
+  if (!obj) return false;
+
+  _slot_t s;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    int idx = _findSlot(obj);
+    if (idx < 0 || !_slots[idx].live || _slots[idx].dying) return false;
+    _slots[idx].dying = true;
+    s = _slots[idx];
+  }
+  // Destructors may themselves use the arena, so run them unlocked
+  if (s.dtor) s.dtor(obj, s.count);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _freeSlot(_findSlot(obj));
+  return true;
+}
+
+bool ModuleArena::owns(const void *p) const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _block && p >= _block && p < _block + _usage.capacity;
+}
+
+ModuleArena::usage_t ModuleArena::getUsage() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _usage;
+}
+
+void *ModuleArena::_allocate(size_t size) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  size = footprint(size > 0 ? size : 1);
+
+  // First fit among slots released through destroy()
+  int idx = -1;
+  for (size_t i = 0; i < _slots.size(); i++) {
+    if (!_slots[i].live && _slots[i].size >= size) {
+      idx = i;
+      break;
+    }
+  }
+  if (idx < 0) {
+    if (!_block || _top + size > _usage.capacity) {
+      _usage.failed++;
+      return nullptr;
+    }
+    _slots.push_back({ _top, size, 0, nullptr, false, false });
+    _top += size;
+    idx = _slots.size() - 1;
+  }
+
+  _slot_t &s = _slots[idx];
+  // Mark the slot taken while the object is being constructed
+  s.live = true;
+  s.dying = false;
+  s.count = 0;
+  s.dtor = nullptr;
+  _usage.used += s.size;
+  if (_usage.used > _usage.peak) _usage.peak = _usage.used;
+  _usage.live++;
+  _usage.total++;
+  return _block + s.offset;
+}
+
+void ModuleArena::_commit(void *p, size_t count, _dtor_t dtor) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  int idx = _findSlot(p);
+  if (idx < 0) return;
+  _slots[idx].count = count;
+  _slots[idx].dtor = dtor;
+}
+
+void ModuleArena::_abandon(void *p) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _freeSlot(_findSlot(p));
+}
+
+int ModuleArena::_findSlot(const void *p) const {
+  if (!_block) return -1;
+  size_t offset = (const char *)p - _block;
+  for (size_t i = 0; i < _slots.size(); i++)
+    if (_slots[i].offset == offset) return i;
+  return -1;
+}
+
+int ModuleArena::_lastLive() const {
+  for (int i = (int)_slots.size() - 1; i >= 0; i--)
+    if (_slots[i].live && !_slots[i].dying) return i;
+  return -1;
+}
+
+void ModuleArena::_freeSlot(int idx) {
+  if (idx < 0 || !_slots[idx].live) return;
+
+  _slot_t &s = _slots[idx];
+  s.live = false;
+  s.dying = false;
+  s.dtor = nullptr;
+  s.count = 0;
+  _usage.used -= s.size;
+  _usage.live--;
+
+  // Give trailing free slots back to the bump pointer
+  while (!_slots.empty() && !_slots.back().live) {
+    _top = _slots.back().offset;
+    _slots.pop_back();
+  }
+}
@@ -0,0 +1,102 @@
+#include "control_modules/MultiRateTargets.hh"
+
+#include <algorithm>
+
+// Tolerance on update times, absorbs rounding in the tick clock
+#define MULTIRATE_TIME_EPS 1e-6
+
+MultiRateTargets::MultiRateTargets() {
+  for (int i = 0; i < 4; i++) {
+    _p0[i] = _v0[i] = Eigen::Vector3d::Zero();
+    _p1[i] = _v1[i] = Eigen::Vector3d::Zero();
+  }
+}
+
+void MultiRateTargets::setRate(double rate) {
+  _rate = (rate > 0) ? rate : 0;
+  _period = (_rate > 0) ? 1.0 / _rate : 0;
+  _pending = true;
+}
+
+void MultiRateTargets::reset() {
+  _type = T_NONE;
+  _pending = true;
+}
+
+bool MultiRateTargets::due(double t) {
+  if (_period <= 0) return true;
+
+  if (_pending) {
+    _pending = false;
+    _next = t + _period;
+    return true;
+  }
+  if (t + MULTIRATE_TIME_EPS < _next) return false;
+
+  // Keep the update phase, but skip ahead if ticks were missed
+  _next += _period;
+  if (_next <= t) _next = t + _period;
+  return true;
+}
+
+void MultiRateTargets::setTargets(target_t type, double t, const Eigen::Vector3d pos[4],
+                                  const Eigen::Vector3d vel[4]) {
+  if (type == _type && _period > 0) {
+    // Start from what is being commanded right now to stay continuous
+    Eigen::Vector3d p[4], v[4];
+    getTargets(t, p, v);
+    for (int i = 0; i < 4; i++) {
+      _p0[i] = p[i];
+      _v0[i] = v[i];
+    }
+  } else {
+    for (int i = 0; i < 4; i++) {
+      _p0[i] = pos[i];
+      _v0[i] = vel[i];
+    }
+  }
+
+  for (int i = 0; i < 4; i++) {
+    _p1[i] = pos[i] + vel[i] * _period;
+    _v1[i] = vel[i];
+  }
+  _type = type;
+  _t0 = t;
+}
+
+MultiRateTargets::target_t MultiRateTargets::getTargets(double t, Eigen::Vector3d pos[4],
+                                                        Eigen::Vector3d vel[4]) const {
+  if (_type == T_NONE) return T_NONE;
+
+  double s = std::max(t - _t0, 0.0);
+
+  if (_period <= 0) {
+    for (int i = 0; i < 4; i++) {
+      pos[i] = _p0[i];
+      vel[i] = _v0[i];
+    }
+  } else if (s < _period) {
+    double T = _period;
+    double u = s / T, u2 = u * u, u3 = u2 * u;
+    double h00 = 2 * u3 - 3 * u2 + 1, h10 = u3 - 2 * u2 + u;
+    double h01 = -2 * u3 + 3 * u2, h11 = u3 - u2;
+    double d00 = (6 * u2 - 6 * u) / T, d10 = 3 * u2 - 4 * u + 1;
+    double d01 = (-6 * u2 + 6 * u) / T, d11 = 3 * u2 - 2 * u;
+    for (int i = 0; i < 4; i++) {
+      pos[i] = h00 * _p0[i] + h10 * T * _v0[i] + h01 * _p1[i] + h11 * T * _v1[i];
+      vel[i] = d00 * _p0[i] + d10 * _v0[i] + d01 * _p1[i] + d11 * _v1[i];
+    }
+  } else if (s < 2 * _period) {
+    // Late update, keep following the last velocity for one more period
+    for (int i = 0; i < 4; i++) {
+      pos[i] = _p1[i] + _v1[i] * (s - _period);
+      vel[i] = _v1[i];
+    }
+  } else {
+    for (int i = 0; i < 4; i++) {
+      pos[i] = _p1[i] + _v1[i] * _period;
+      vel[i] = Eigen::Vector3d::Zero();
+    }
+  }
+  return _type;
+}